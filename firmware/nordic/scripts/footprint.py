@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+Per-module flash/RAM footprint report for the application library.
+
+Runs the toolchain's `size` on the app archive, groups sections per source
+file and compares them against the budget file. Exits non-zero when a module
+is over budget or has no budget, so the build fails. Without a budget file
+the sizes are only reported.
+
+Budgets come from a measured build, never by hand:
+
+    footprint.py --size <size> --budget footprint_budget.json --write-budget libapp.a
+
+    flash = text + data     (data initializers are stored in flash)
+    ram   = data + bss      (bss includes .noinit and thread stacks)
+
+Object sizes are taken before the final link, so sections later removed by
+--gc-sections are still counted. The report is an upper bound.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+
+def module_sizes(size_tool, archive):
+    """Return {module: {"flash": n, "ram": n}} for each object in the archive."""
+    output = subprocess.run([size_tool, "-B", archive], check=True, capture_output=True, text=True).stdout
+    modules = {}
+    for line in output.splitlines()[1:]:
+        fields = line.split(None, 5)
+        if len(fields) < 6:
+            continue
+        text, data, bss = (int(v) for v in fields[:3])
+        # "led.c.obj (ex libapp.a)" -> "led"
+        name = os.path.basename(fields[5].split(" (ex ")[0]).split(".")[0]
+        module = modules.setdefault(name, {"flash": 0, "ram": 0})
+        module["flash"] += text + data
+        module["ram"] += data + bss
+    return modules
+
+
+def write_budget(path, modules, margin):
+    """Write measured sizes plus a margin (percent, rounded up to 16 bytes) as the new budget."""
+    def limit(used):
+        return -(-(used * (100 + margin) // 100) // 16) * 16
+    budgets = {name: {"flash": limit(used["flash"]), "ram": limit(used["ram"])} for name, used in sorted(modules.items())}
+    with open(path, "w") as f:
+        json.dump(budgets, f, indent=4)
+        f.write("\n")
+    print(f"wrote {path} from measured sizes (+{margin}%)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--size", default="size", help="size tool for the target toolchain")
+    parser.add_argument("--budget", required=True, help="JSON file with per-module flash/ram limits in bytes")
+    parser.add_argument("--write-budget", action="store_true", help="replace the budget file with the measured sizes")
+    parser.add_argument("--margin", type=int, default=10, help="headroom in percent when writing budgets")
+    parser.add_argument("archive", help="application static library")
+    args = parser.parse_args()
+
+    modules = module_sizes(args.size, args.archive)
+    if args.write_budget:
+        write_budget(args.budget, modules, args.margin)
+    if os.path.exists(args.budget):
+        with open(args.budget) as f:
+            budgets = json.load(f)
+    else:
+        budgets = None
+
+    failures = 0
+    print(f"{'module':<12} {'flash':>7} {'budget':>7} {'ram':>7} {'budget':>7}")
+    for name in sorted(modules):
+        used = modules[name]
+        if budgets is None:
+            print(f"{name:<12} {used['flash']:>7} {'-':>7} {used['ram']:>7} {'-':>7}")
+            continue
+        budget = budgets.get(name)
+        if budget is None:
+            print(f"{name:<12} {used['flash']:>7} {'-':>7} {used['ram']:>7} {'-':>7}  NO BUDGET")
+            failures += 1
+            continue
+        status = []
+        if used["flash"] > budget["flash"]:
+            status.append("FLASH OVER")
+        if used["ram"] > budget["ram"]:
+            status.append("RAM OVER")
+        failures += len(status)
+        print(f"{name:<12} {used['flash']:>7} {budget['flash']:>7} {used['ram']:>7} {budget['ram']:>7}  {' '.join(status)}".rstrip())
+
+    total_flash = sum(m["flash"] for m in modules.values())
+    total_ram = sum(m["ram"] for m in modules.values())
+    print(f"{'total':<12} {total_flash:>7} {'':>7} {total_ram:>7}")
+
+    if budgets is None:
+        print(f"note: no budget file ({args.budget}), sizes reported only")
+    if failures:
+        print(f"error: footprint budget exceeded ({args.budget})", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
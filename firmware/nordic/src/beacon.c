@@ -0,0 +1,247 @@
+/**
+ * @file beacon.c
+ * @author agent (agent@local)
+ * @brief File to broadcast a connectionless status beacon in extended advertising
+ *          The payload is encoded once per status change and handed to the controller,
+ *          which repeats it every advertising event without waking the CPU
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include "beacon.h"
+
+#include "device.h"
+#include "led.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <string.h>
+
+LOG_MODULE_REGISTER(BEACON, CONFIG_APP_LOG_LEVEL);
+
+/* Identity address stays the same across interval changes, so observers can follow each light */
+#define BEACON_ADV_OPTIONS          (BT_LE_ADV_OPT_EXT_ADV | BT_LE_ADV_OPT_USE_IDENTITY)
+
+/* Advertising interval is in units of 0.625 ms */
+#define BEACON_MS_TO_INTERVAL(ms)   (((ms) * 8) / 5)
+
+/* Estimated on-air time per advertising event on 1M PHY (8 us per byte)
+    ADV_EXT_IND on each of the 3 primary channels:
+        preamble 1 + access address 4 + header 2 + extended header 7 (ADI, AuxPtr) + CRC 3
+    AUX_ADV_IND on one secondary channel:
+        preamble 1 + access address 4 + header 2 + extended header 10 (AdvA, ADI)
+        + AD length/type 2 + manufacturer data + CRC 3
+    Plus radio ramp-up of 40 us per packet */
+#define BEACON_RAMP_UP_US           40
+#define BEACON_PRIMARY_PDU_BYTES    17
+#define BEACON_AUX_PDU_BYTES        (20 + 2 + sizeof(_manuf_data))
+#define BEACON_EVENT_ON_US          ((3 * (BEACON_PRIMARY_PDU_BYTES * 8 + BEACON_RAMP_UP_US)) + (BEACON_AUX_PDU_BYTES * 8 + BEACON_RAMP_UP_US))
+
+/**
+ * LOCAL VARIABLES
+ */
+
+typedef struct __packed
+{
+    uint8_t version;
+    uint8_t pattern;
+    uint8_t state;
+    uint8_t battery_level;
+    uint8_t reset_src;
+    uint8_t change_count;   // Lets observers spot changes without comparing fields
+}
+beacon_payload_t;
+
+static struct
+{
+    uint8_t company_id[2];
+    beacon_payload_t payload;
+} __packed _manuf_data;
+
+static const struct bt_data _adv_data[] =
+{
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, &_manuf_data, sizeof(_manuf_data)),
+};
+
+static struct bt_le_ext_adv * _adv;
+static bool _fast;
+static int64_t _interval_start_ms;  // Uptime when current interval was applied
+static uint32_t _events_before;     // Events counted at previous interval changes
+static bool _started;
+static int64_t _started_ms;
+static uint32_t _encodes;
+
+static void beacon_update_handler(struct k_work * work);
+static K_WORK_DEFINE(_update_work, beacon_update_handler);
+
+static void beacon_slow_handler(struct k_work * work);
+static K_WORK_DELAYABLE_DEFINE(_slow_work, beacon_slow_handler);
+
+/**
+ * FUNCTION DEFINITIONS
+ */
+
+/**
+ * @brief Advertising events since the current interval was applied
+ * 
+ * @return uint32_t 
+ */
+static uint32_t beacon_interval_events(void)
+{
+    uint32_t interval_ms = _fast ? BEACON_FAST_INTERVAL_MS : BEACON_SLOW_INTERVAL_MS;
+    return (uint32_t)((k_uptime_get() - _interval_start_ms) / interval_ms);
+}
+
+/**
+ * @brief Change advertising interval
+ *          The advertising set must be stopped to change its parameters
+ * 
+ * @param fast 
+ */
+static void beacon_interval_set(bool fast)
+{
+    int err;
+    uint32_t interval = BEACON_MS_TO_INTERVAL(fast ? BEACON_FAST_INTERVAL_MS : BEACON_SLOW_INTERVAL_MS);
+    struct bt_le_adv_param param = BT_LE_ADV_PARAM_INIT(BEACON_ADV_OPTIONS, interval, interval, NULL);
+
+    if (fast == _fast)
+    {
+        return;
+    }
+    err = bt_le_ext_adv_stop(_adv);
+    if (err)
+    {
+        LOG_ERR("Failed to stop beacon (%d)", err);
+        return;
+    }
+    err = bt_le_ext_adv_update_param(_adv, &param);
+    if (err)
+    {
+        LOG_ERR("Failed to change beacon interval (%d)", err);
+    }
+    else
+    {
+        _events_before += beacon_interval_events();
+        _interval_start_ms = k_uptime_get();
+        _fast = fast;
+    }
+    err = bt_le_ext_adv_start(_adv, BT_LE_EXT_ADV_START_DEFAULT);
+    if (err)
+    {
+        LOG_ERR("Failed to restart beacon (%d)", err);
+    }
+}
+
+static void beacon_update_handler(struct k_work * work)
+{
+    int err;
+    beacon_payload_t payload =
+    {
+        .version = BEACON_PAYLOAD_VERSION,
+        .pattern = led_get_pattern(),
+        .state = device_get_state(),
+        .battery_level = device_get_battery_level(),
+        .reset_src = device_get_reset_src(),
+        .change_count = _manuf_data.payload.change_count,
+    };
+
+    if (_adv == NULL)
+    {
+        return;
+    }
+    /* Only encode when something changed, controller keeps repeating the last payload */
+    if (memcmp(&payload, &_manuf_data.payload, sizeof(payload)) == 0)
+    {
+        return;
+    }
+    payload.change_count++;
+    _manuf_data.payload = payload;
+    _encodes++;
+    err = bt_le_ext_adv_set_data(_adv, _adv_data, ARRAY_SIZE(_adv_data), NULL, 0);
+    if (err)
+    {
+        LOG_ERR("Failed to set beacon data (%d)", err);
+        return;
+    }
+
+    /* Advertise quickly for a short while so observers pick up the change */
+    if (_started)
+    {
+        beacon_interval_set(true);
+        k_work_reschedule(&_slow_work, K_MSEC(BEACON_FAST_DURATION_MS));
+    }
+}
+
+static void beacon_slow_handler(struct k_work * work)
+{
+    beacon_stats_t stats;
+
+    beacon_interval_set(false);
+    beacon_get_stats(&stats);
+    LOG_INF("Encodes %u, events %u, radio on-time %u us/h", stats.encodes, stats.adv_events, stats.radio_on_us_per_hour);
+}
+
+void beacon_init(void)
+{
+    int err;
+    struct bt_le_adv_param param = BT_LE_ADV_PARAM_INIT(BEACON_ADV_OPTIONS,
+        BEACON_MS_TO_INTERVAL(BEACON_SLOW_INTERVAL_MS), BEACON_MS_TO_INTERVAL(BEACON_SLOW_INTERVAL_MS), NULL);
+
+    sys_put_le16(BEACON_COMPANY_ID, _manuf_data.company_id);
+    err = bt_le_ext_adv_create(&param, NULL, &_adv);
+    if (err)
+    {
+        /* Light still works without the beacon */
+        LOG_ERR("Failed to create beacon advertising set (%d)", err);
+        _adv = NULL;
+        return;
+    }
+    /* Encode initial payload */
+    k_work_submit(&_update_work);
+}
+
+void beacon_start(void)
+{
+    int err;
+
+    if ((_adv == NULL) || _started)
+    {
+        return;
+    }
+    err = bt_le_ext_adv_start(_adv, BT_LE_EXT_ADV_START_DEFAULT);
+    if (err)
+    {
+        LOG_ERR("Failed to start beacon (%d)", err);
+        return;
+    }
+    _started = true;
+    _started_ms = k_uptime_get();
+    _interval_start_ms = _started_ms;
+}
+
+void beacon_update(void)
+{
+    /* Nothing to encode until the advertising set exists */
+    if (_adv == NULL)
+    {
+        return;
+    }
+    /* Encode from the system work queue so callers never wait on the controller */
+    k_work_submit(&_update_work);
+}
+
+void beacon_get_stats(beacon_stats_t * stats)
+{
+    int64_t elapsed_ms = _started ? (k_uptime_get() - _started_ms) : 0;
+
+    stats->encodes = _encodes;
+    stats->adv_events = _started ? (_events_before + beacon_interval_events()) : 0;
+    stats->radio_on_us_per_hour = elapsed_ms ?
+        (uint32_t)(((uint64_t)stats->adv_events * BEACON_EVENT_ON_US * 3600000) / elapsed_ms) : 0;
+}
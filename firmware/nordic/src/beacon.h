@@ -0,0 +1,57 @@
+/**
+ * @file beacon.h
+ * @author agent (agent@local)
+ * @brief Header file for beacon.c
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#ifndef __BEACON_H__
+#define __BEACON_H__
+
+#include <stdint.h>
+
+#define BEACON_COMPANY_ID           0xFFFF  // Reserved for testing until a company ID is assigned
+#define BEACON_PAYLOAD_VERSION      1
+#define BEACON_SLOW_INTERVAL_MS     1000    // Interval while status is steady
+#define BEACON_FAST_INTERVAL_MS     100     // Interval right after a status change
+#define BEACON_FAST_DURATION_MS     5000
+
+typedef struct
+{
+    uint32_t encodes;               // Times the payload was encoded (once per status change)
+    uint32_t adv_events;            // Advertising events since the beacon started (estimated from intervals)
+    uint32_t radio_on_us_per_hour;  // Estimated radio TX time per hour at the observed event rate
+}
+beacon_stats_t;
+
+/**
+ * @brief Create the status beacon advertising set
+ * 
+ */
+void beacon_init(void);
+
+/**
+ * @brief Start broadcasting the status beacon
+ * 
+ */
+void beacon_start(void);
+
+/**
+ * @brief Notify the beacon that the device status may have changed
+ *          The payload is only re-encoded if the status actually changed
+ * 
+ */
+void beacon_update(void);
+
+/**
+ * @brief Get beacon statistics
+ * 
+ * @param stats 
+ */
+void beacon_get_stats(beacon_stats_t * stats);
+
+#endif  /* __BEACON_H__ */
@@ -0,0 +1,118 @@
+/**
+ * @file ble.c
+ * @author agent (agent@local)
+ * @brief File to enable Bluetooth and handle connections
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include "ble.h"
+
+#include "device.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(BLE, CONFIG_APP_LOG_LEVEL);
+
+/**
+ * LOCAL VARIABLES
+ */
+
+static const struct bt_data _adv_data[] =
+{
+    BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+    BT_DATA(BT_DATA_NAME_COMPLETE, CONFIG_BT_DEVICE_NAME, sizeof(CONFIG_BT_DEVICE_NAME) - 1),
+};
+
+static void ble_adv_work_handler(struct k_work * work);
+static K_WORK_DEFINE(_adv_work, ble_adv_work_handler);
+
+static void ble_adv_stop_handler(struct k_work * work);
+static K_WORK_DELAYABLE_DEFINE(_adv_stop_work, ble_adv_stop_handler);
+
+/**
+ * FUNCTION DEFINITIONS
+ */
+
+static void ble_adv_work_handler(struct k_work * work)
+{
+    int err;
+
+    /* Slow interval, the phone only needs to find the light once per window */
+    err = bt_le_adv_start(BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_ONE_TIME,
+        BT_GAP_ADV_SLOW_INT_MIN, BT_GAP_ADV_SLOW_INT_MAX, NULL), _adv_data, ARRAY_SIZE(_adv_data), NULL, 0);
+    if (err && (err != -EALREADY))
+    {
+        LOG_ERR("Advertising failed to start (%d)", err);
+        return;
+    }
+    /* Stop after the connect window to keep the radio quiet */
+    k_work_reschedule(&_adv_stop_work, K_MSEC(BLE_ADV_WINDOW_MS));
+}
+
+static void ble_adv_stop_handler(struct k_work * work)
+{
+    int err;
+
+    err = bt_le_adv_stop();
+    if (err)
+    {
+        LOG_ERR("Advertising failed to stop (%d)", err);
+        return;
+    }
+    LOG_INF("Connect window closed");
+}
+
+static void ble_connected(struct bt_conn * conn, uint8_t err)
+{
+    if (err)
+    {
+        LOG_WRN("Connection failed (0x%02x)", err);
+        ble_adv_start();
+        return;
+    }
+    LOG_INF("Connected");
+    /* Advertising already stopped on connection */
+    k_work_cancel_delayable(&_adv_stop_work);
+}
+
+static void ble_disconnected(struct bt_conn * conn, uint8_t reason)
+{
+    LOG_INF("Disconnected (0x%02x)", reason);
+    /* Keep advertising while the light is on */
+    if (device_get_state() == DEVICE_STATE_RUN)
+    {
+        ble_adv_start();
+    }
+}
+
+BT_CONN_CB_DEFINE(_conn_callbacks) =
+{
+    .connected = ble_connected,
+    .disconnected = ble_disconnected,
+};
+
+void ble_init(void)
+{
+    int err;
+
+    err = bt_enable(NULL);
+    __ASSERT(err == 0, "Error enabling Bluetooth");
+}
+
+void ble_adv_start(void)
+{
+    /* Nothing to advertise until Bluetooth is enabled */
+    if (!bt_is_ready())
+    {
+        return;
+    }
+    /* Advertising can't be restarted from the connection callbacks directly */
+    k_work_submit(&_adv_work);
+}
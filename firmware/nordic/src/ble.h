@@ -0,0 +1,30 @@
+/**
+ * @file ble.h
+ * @author agent (agent@local)
+ * @brief Header file for ble.c
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#ifndef __BLE_H__
+#define __BLE_H__
+
+#define BLE_ADV_WINDOW_MS   60000   // Connectable advertising time after wakeup or a disconnect
+
+/**
+ * @brief Enable the Bluetooth stack
+ * 
+ */
+void ble_init(void);
+
+/**
+ * @brief Start connectable advertising for BLE_ADV_WINDOW_MS
+ *          The window restarts automatically after a disconnect while running
+ * 
+ */
+void ble_adv_start(void);
+
+#endif  /* __BLE_H__ */
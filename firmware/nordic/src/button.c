@@ -18,7 +18,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
-LOG_MODULE_REGISTER(BUTTON, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(BUTTON, CONFIG_APP_LOG_LEVEL);
 
 /* GPIO */
 static const struct gpio_dt_spec _button_dt = GPIO_DT_SPEC_GET(DT_NODELABEL(user_gpio), button_gpios);
@@ -28,22 +28,38 @@ const struct gpio_dt_spec * button_get_dt_spec(void)
     return &_button_dt;
 }
 
-void button_thread(void)
+button_event_t button_process(uint32_t * buffer, bool pressed)
 {
     /* The button buffer works by shifting left and ORing the button state
         If the buffer is all 1s, then a long press occurred
         If the buffer is some 1s followed by a 0, then a press was released */
-    uint32_t button_buffer = 0;
+    *buffer = (*buffer << 1) | pressed;
+    /* Check for button events */
+    if (*buffer == 0x7FFFFFFF)
+    {
+        /* Long press occurred
+            We use 0x7FFFFFFF so that it won't constantly detect long presses if still held */
+        return BUTTON_EVENT_LONG_PRESS;
+    }
+    else if (*buffer == 0xFFFFFFFE)
+    {
+        /* Long press released */
+        return BUTTON_EVENT_LONG_RELEASE;
+    }
+    else if ((*buffer & 0x3) == 0x2)
+    {
+        /* Short press released */
+        return BUTTON_EVENT_SHORT_RELEASE;
+    }
+    return BUTTON_EVENT_NONE;
+}
 
-    while (1)
+void button_handle_event(button_event_t event)
+{
+    switch (event)
     {
-        /* Place button state into buffer */
-        button_buffer = (button_buffer << 1) | gpio_pin_get_dt(&_button_dt);
-        /* Check for button events */
-        if (button_buffer == 0x7FFFFFFF)
+        case (BUTTON_EVENT_LONG_PRESS):
         {
-            /* Long press occurred
-                We use 0x7FFFFFFF so that it won't constantly detect long presses if still held */
             LOG_DBG("Long press");
             if (device_get_state() == DEVICE_STATE_POWEROFF)
             {
@@ -55,15 +71,17 @@ void button_thread(void)
                 /* Power off device if running */
                 device_poweroff();
             }
+            break;
         }
-        else if (button_buffer == 0xFFFFFFFE)
+
+        case (BUTTON_EVENT_LONG_RELEASE):
         {
-            /* Long press released */
             LOG_DBG("Long press released");
+            break;
         }
-        else if ((button_buffer & 0x3) == 0x2)
+
+        case (BUTTON_EVENT_SHORT_RELEASE):
         {
-            /* Short press released */
             LOG_DBG("Short press released");
             if (device_get_state() == DEVICE_STATE_POWEROFF)
             {
@@ -75,8 +93,27 @@ void button_thread(void)
                 /* Toggle LED pattern */
                 led_toggle_pattern();
             }
+            break;
         }
 
+        default:
+        {
+            break;
+        }
+    }
+}
+
+void button_thread(void)
+{
+    uint32_t button_buffer = 0;
+
+    while (1)
+    {
+        /* Place button state into buffer and handle any event */
+        button_handle_event(button_process(&button_buffer, gpio_pin_get_dt(&_button_dt) > 0));
+
+        /* Button thread is alive */
+        device_wdt_feed();
         /* Delay until next poll interval */
         k_msleep(1000 / BUTTON_POLL_HZ);
     }
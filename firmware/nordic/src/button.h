@@ -17,6 +17,18 @@
 
 #define BUTTON_POLL_HZ              20
 
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+    BUTTON_EVENT_NONE,
+    BUTTON_EVENT_LONG_PRESS,
+    BUTTON_EVENT_LONG_RELEASE,
+    BUTTON_EVENT_SHORT_RELEASE,
+}
+button_event_t;
+
 /**
  * @brief Get the button GPIO DT spec
  * 
@@ -24,6 +36,22 @@
  */
 const struct gpio_dt_spec * button_get_dt_spec(void);
 
+/**
+ * @brief Add a button sample to the press buffer and detect events
+ * 
+ * @param buffer press buffer, starts at 0
+ * @param pressed current button state
+ * @return button_event_t 
+ */
+button_event_t button_process(uint32_t * buffer, bool pressed);
+
+/**
+ * @brief Act on a button event depending on device state
+ * 
+ * @param event 
+ */
+void button_handle_event(button_event_t event);
+
 /**
  * @brief This thread reads button inputs and handles short/long presses
  * 
@@ -12,21 +12,39 @@
 
 #include "device.h"
 
+#include "beacon.h"
+#include "ble.h"
 #include "button.h"
 #include "led.h"
+#include "retained.h"
+#include "stream.h"
 
 #include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/watchdog.h>
+#include <zephyr/fatal.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/sys/poweroff.h>
+#include <zephyr/sys/reboot.h>
+#include <zephyr/toolchain.h>
 
-LOG_MODULE_REGISTER(DEVICE, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(DEVICE, CONFIG_APP_LOG_LEVEL);
 
 /**
  * LOCAL VARIABLES
  */
 
 static device_state_t _device_state;
+static device_reset_src_t _reset_src;
+static bool _reset_src_read;
+static uint8_t _battery_level = DEVICE_BATTERY_LEVEL_UNKNOWN;  // No battery monitoring yet (nPM1300 fuel gauge)
+
+static void device_warm_stable_handler(struct k_work * work);
+static K_WORK_DELAYABLE_DEFINE(_warm_stable_work, device_warm_stable_handler);
+
+/* Watchdog */
+static const struct device * _wdt = DEVICE_DT_GET(DT_NODELABEL(wdt0));
+static int _wdt_channel = -1;
 
 /**
  * FUNCTION DEFINITIONS
@@ -40,67 +58,225 @@ device_state_t device_get_state(void)
 void device_set_state(device_state_t new_state)
 {
     _device_state = new_state;
+    /* Keep state for a warm restart */
+    retained_set_state(new_state);
+    /* Broadcast new state */
+    beacon_update();
 }
 
 void device_wakeup(void)
 {
+    /* Rider started the light, any earlier warm restarts are over */
+    retained_clear_warm_restarts();
     /* Set device state */
     device_set_state(DEVICE_STATE_RUN);
     /* Set boot LED pattern */
     led_set_pattern(LED_PATTERN_PULSE);
+    /* Let the phone connect */
+    ble_adv_start();
+    /* Broadcast status to nearby riders */
+    beacon_start();
 }
 
-void device_poweroff()
+bool device_warm_restart(device_reset_src_t reset_src)
+{
+    device_state_t state;
+    led_pattern_t pattern;
+    retained_crash_t crash;
+
+    /* Validate retained block first so it's ready for use on every boot */
+    if (!retained_init())
+    {
+        return false;
+    }
+    /* Only restore after unexpected resets */
+    if ((reset_src != DEVICE_RESET_SRC_WATCHDOG) &&
+        (reset_src != DEVICE_RESET_SRC_CPU_LOCKUP) &&
+        (reset_src != DEVICE_RESET_SRC_SOFT_RESET))
+    {
+        return false;
+    }
+
+    retained_get_crash(&crash);
+    if ((crash.fault != RETAINED_FAULT_NONE) && !crash.reported)
+    {
+        LOG_WRN("Fault %u (reason %u) at PC 0x%08x LR 0x%08x, %u total",
+            crash.fault, crash.reason, crash.pc, crash.lr, crash.count);
+        /* Record stays for upload, but won't be blamed for a later reset */
+        retained_set_crash_reported();
+    }
+
+    retained_get_state(&state, &pattern);
+    if ((state != DEVICE_STATE_RUN) || (pattern >= LED_PATTERN_NUM_PATTERNS))
+    {
+        return false;
+    }
+    /* Give up if restoring keeps faulting, so the rider can still turn the light off */
+    if (retained_add_warm_restart() > DEVICE_WARM_RESTART_MAX)
+    {
+        LOG_ERR("Too many warm restarts, falling back to cold boot");
+        device_set_state(DEVICE_STATE_POWEROFF);
+        return false;
+    }
+    /* Light back on straight away, skip waiting for a long press */
+    device_set_state(DEVICE_STATE_RUN);
+    led_set_pattern(pattern);
+    LOG_WRN("Warm restart after reset source %u", reset_src);
+    /* Running long enough afterwards means the fault didn't repeat */
+    k_work_schedule(&_warm_stable_work, K_MSEC(DEVICE_WARM_STABLE_MS));
+    return true;
+}
+
+/**
+ * @brief Device ran cleanly after a warm restart, allow future warm restarts again
+ * 
+ * @param work 
+ */
+static void device_warm_stable_handler(struct k_work * work)
+{
+    retained_clear_warm_restarts();
+}
+
+/**
+ * @brief Watchdog is about to reset the device, record it
+ * 
+ * @param dev 
+ * @param channel_id 
+ */
+static void device_wdt_callback(const struct device * dev, int channel_id)
+{
+    retained_save_crash(RETAINED_FAULT_WATCHDOG, 0, 0, 0);
+}
+
+void device_wdt_init(void)
 {
     int err;
+    struct wdt_timeout_cfg wdt_config =
+    {
+        .window.min = 0,
+        .window.max = DEVICE_WDT_TIMEOUT_MS,
+        .callback = device_wdt_callback,
+        .flags = WDT_FLAG_RESET_SOC,
+    };
+
+    __ASSERT(device_is_ready(_wdt), "Watchdog not ready");
+    _wdt_channel = wdt_install_timeout(_wdt, &wdt_config);
+    __ASSERT(_wdt_channel >= 0, "Error installing watchdog timeout");
+    err = wdt_setup(_wdt, WDT_OPT_PAUSE_HALTED_BY_DBG);
+    __ASSERT(err == 0, "Error starting watchdog");
+}
 
+void device_wdt_feed(void)
+{
+    if (_wdt_channel >= 0)
+    {
+        wdt_feed(_wdt, _wdt_channel);
+    }
+}
+
+/**
+ * @brief Record fatal errors and reboot so the light comes back through a warm restart
+ *          Overrides the kernel default, which halts
+ * 
+ * @param reason 
+ * @param esf 
+ */
+void k_sys_fatal_error_handler(unsigned int reason, const z_arch_esf_t * esf)
+{
+    uint32_t pc = 0;
+    uint32_t lr = 0;
+
+    if (esf != NULL)
+    {
+        pc = esf->basic.pc;
+        lr = esf->basic.lr;
+    }
+    retained_save_crash(RETAINED_FAULT_FATAL_ERROR, reason, pc, lr);
+    LOG_PANIC();
+    sys_reboot(SYS_REBOOT_WARM);
+}
+
+void device_poweroff()
+{
     /* Change device state */
     device_set_state(DEVICE_STATE_POWEROFF);
+    /* Stop the phone driving the light */
+    stream_disconnect();
     /* Clear LED */
     led_set_pattern(LED_PATTERN_OFF);
+    /* Put microcontroller to sleep */
+    device_sleep();
+}
+
+__weak void device_sleep(void)
+{
+    int err;
+
     /* Wait until button released */
-    while (gpio_pin_get_dt(button_get_dt_spec()));
+    while (gpio_pin_get_dt(button_get_dt_spec()))
+    {
+        device_wdt_feed();
+    }
     k_msleep(250);  // delay a small period for button bouncing
     /* Configure interrupt for button (wakeup source) */
     err = gpio_pin_interrupt_configure_dt(button_get_dt_spec(), GPIO_INT_LEVEL_ACTIVE);
     __ASSERT(err == 0, "Error changing button interrupt");
     /* Clear LATCH register */
     NRF_GPIO->LATCH = NRF_GPIO->LATCH;
-    /* Put microcontroller to sleep */
     LOG_WRN("Powering device off");
     sys_poweroff();
 }
 
 device_reset_src_t device_get_reset_src(void)
 {
+    /* Register is cleared after reading, so keep the first result */
+    if (_reset_src_read)
+    {
+        return _reset_src;
+    }
+
     /* Get reset source */
     uint32_t reset_src = NRF_POWER->RESETREAS;
     /* Clear reset source register */
     NRF_POWER->RESETREAS = 0xFFFFFFFF;
+    _reset_src_read = true;
 
     /* Determine reset reason */
     if (reset_src & POWER_RESETREAS_OFF_Msk)
     {
-        return DEVICE_RESET_SRC_GPIO_WAKEUP;
+        _reset_src = DEVICE_RESET_SRC_GPIO_WAKEUP;
     }
     else if (reset_src & POWER_RESETREAS_LOCKUP_Msk)
     {
-        return DEVICE_RESET_SRC_CPU_LOCKUP;
+        _reset_src = DEVICE_RESET_SRC_CPU_LOCKUP;
     }
     else if (reset_src & POWER_RESETREAS_SREQ_Msk)
     {
-        return DEVICE_RESET_SRC_SOFT_RESET;
+        _reset_src = DEVICE_RESET_SRC_SOFT_RESET;
     }
     else if (reset_src & POWER_RESETREAS_DOG_Msk)
     {
-        return DEVICE_RESET_SRC_WATCHDOG;
+        _reset_src = DEVICE_RESET_SRC_WATCHDOG;
     }
     else if (reset_src & POWER_RESETREAS_RESETPIN_Msk)
     {
-        return DEVICE_RESET_SRC_RESET_PIN;
+        _reset_src = DEVICE_RESET_SRC_RESET_PIN;
     }
     else
     {
-        return DEVICE_RESET_SRC_OTHER;
+        _reset_src = DEVICE_RESET_SRC_OTHER;
     }
+    return _reset_src;
+}
+
+uint8_t device_get_battery_level(void)
+{
+    return _battery_level;
+}
+
+void device_set_battery_level(uint8_t level)
+{
+    _battery_level = level;
+    /* Broadcast new battery level */
+    beacon_update();
 }
\ No newline at end of file
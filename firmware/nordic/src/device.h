@@ -35,6 +35,11 @@ typedef enum
 }
 device_reset_src_t;
 
+#define DEVICE_BATTERY_LEVEL_UNKNOWN    0xFF
+#define DEVICE_WDT_TIMEOUT_MS           1000    // Button thread feeds the watchdog every poll
+#define DEVICE_WARM_RESTART_MAX         3       // Consecutive warm restarts before falling back to a cold boot
+#define DEVICE_WARM_STABLE_MS           10000   // Run time after a warm restart that counts as a clean run
+
 /**
  * FUNCTION DECLARATIONS
  */
@@ -58,6 +63,28 @@ void device_set_state(device_state_t new_state);
  */
 void device_wakeup(void);
 
+/**
+ * @brief Restore the light after an unexpected reset without waiting for a long press
+ *          Only restores if the device was running and the retained state is valid
+ *          Also prepares the retained state, so must be called once at boot
+ * 
+ * @param reset_src 
+ * @return true if the device was restored
+ */
+bool device_warm_restart(device_reset_src_t reset_src);
+
+/**
+ * @brief Start the watchdog
+ * 
+ */
+void device_wdt_init(void);
+
+/**
+ * @brief Feed the watchdog
+ * 
+ */
+void device_wdt_feed(void);
+
 /**
  * @brief Turn the device off
  *          Handles cleanup before shutting off
@@ -65,11 +92,33 @@ void device_wakeup(void);
  */
 void device_poweroff();
 
+/**
+ * @brief Wait for the button to release and enter System OFF
+ *          Weak so a build can power cycle without sleeping
+ * 
+ */
+void device_sleep(void);
+
 /**
  * @brief Get the device wakeup reason
+ *          The reset reason register is read and cleared on the first call only
  * 
  * @return device_reset_src_t 
  */
 device_reset_src_t device_get_reset_src(void);
 
+/**
+ * @brief Get the battery level
+ * 
+ * @return uint8_t percent, or DEVICE_BATTERY_LEVEL_UNKNOWN
+ */
+uint8_t device_get_battery_level(void);
+
+/**
+ * @brief Update the battery level
+ * 
+ * @param level percent
+ */
+void device_set_battery_level(uint8_t level);
+
 #endif  /* __DEVICE_H__ */
\ No newline at end of file
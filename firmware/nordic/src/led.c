@@ -11,12 +11,20 @@
 
 #include "led.h"
 
+#include "beacon.h"
+#include "retained.h"
+
 #include <nrfx_gpiote.h>
 #include <nrfx_ppi.h>
 #include <nrfx_pwm.h>
 #include <nrfx_timer.h>
 
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/barrier.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <string.h>
 
 #if (LED_TIMER_INSTANCE == 0)
 #define LED_TIMER_IRQN       TIMER0_IRQn
@@ -30,17 +38,17 @@
 #define LED_TIMER_IRQN       TIMER4_IRQn
 #endif
 
-LOG_MODULE_REGISTER(LED, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(LED, CONFIG_APP_LOG_LEVEL);
 
 /**
  * @brief Pattern for constant max brightness
  * 
  */
-nrf_pwm_values_common_t _pwm_pattern_on[] =
+static const nrf_pwm_values_common_t _pwm_pattern_on[] =
 {
     100,
 };
-nrf_pwm_sequence_t _pwm_seq_on =
+static const nrf_pwm_sequence_t _pwm_seq_on =
 {
     .values = { _pwm_pattern_on },
     .length = NRFX_ARRAY_SIZE(_pwm_pattern_on),
@@ -52,11 +60,11 @@ nrf_pwm_sequence_t _pwm_seq_on =
  * @brief Pattern for constant medium brightness
  * 
  */
-nrf_pwm_values_common_t _pwm_pattern_mid[] =
+static const nrf_pwm_values_common_t _pwm_pattern_mid[] =
 {
     600,
 };
-nrf_pwm_sequence_t _pwm_seq_mid =
+static const nrf_pwm_sequence_t _pwm_seq_mid =
 {
     .values = { _pwm_pattern_mid },
     .length = NRFX_ARRAY_SIZE(_pwm_pattern_mid),
@@ -68,11 +76,11 @@ nrf_pwm_sequence_t _pwm_seq_mid =
  * @brief Pattern for constant low brightness
  * 
  */
-nrf_pwm_values_common_t _pwm_pattern_dim[] =
+static const nrf_pwm_values_common_t _pwm_pattern_dim[] =
 {
     1000,
 };
-nrf_pwm_sequence_t _pwm_seq_dim =
+static const nrf_pwm_sequence_t _pwm_seq_dim =
 {
     .values = { _pwm_pattern_dim },
     .length = NRFX_ARRAY_SIZE(_pwm_pattern_dim),
@@ -84,7 +92,7 @@ nrf_pwm_sequence_t _pwm_seq_dim =
  * @brief Pattern for dim blinking
  * 
  */
-nrf_pwm_values_common_t _pwm_pattern_dim_blink[] =
+static const nrf_pwm_values_common_t _pwm_pattern_dim_blink[] =
 {
     600,  1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 600,
     1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000,
@@ -97,7 +105,7 @@ nrf_pwm_values_common_t _pwm_pattern_dim_blink[] =
     1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000,
     1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000,
 };
-nrf_pwm_sequence_t _pwm_seq_dim_blink =
+static const nrf_pwm_sequence_t _pwm_seq_dim_blink =
 {
     .values = { _pwm_pattern_dim_blink },
     .length = NRFX_ARRAY_SIZE(_pwm_pattern_dim_blink),
@@ -109,7 +117,7 @@ nrf_pwm_sequence_t _pwm_seq_dim_blink =
  * @brief Pattern for pulsing
  * 
  */
-nrf_pwm_values_common_t _pwm_pattern_pulse[] =
+static const nrf_pwm_values_common_t _pwm_pattern_pulse[] =
 {
     990,  980,  970,  960,  950,  940,  930,  920,  910,  900,
     890,  880,  870,  860,  850,  840,  830,  820,  810,  800,
@@ -124,7 +132,7 @@ nrf_pwm_values_common_t _pwm_pattern_pulse[] =
     900,  910,  920,  930,  940,  950,  960,  970,  980,  990,
     1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000,
 };
-nrf_pwm_sequence_t _pwm_seq_pulse =
+static const nrf_pwm_sequence_t _pwm_seq_pulse =
 {
     .values = { _pwm_pattern_pulse },
     .length = NRFX_ARRAY_SIZE(_pwm_pattern_pulse),
@@ -132,6 +140,32 @@ nrf_pwm_sequence_t _pwm_seq_pulse =
     .end_delay = 1000  // no delay between repeats
 };
 
+/**
+ * @brief RAM copy of the playing pattern
+ *          PWM EasyDMA can only read from RAM, so patterns stay in flash and
+ *          the selected one is copied here
+ * 
+ */
+#define LED_PWM_DMA_SAMPLES MAX(NRFX_ARRAY_SIZE(_pwm_pattern_pulse), NRFX_ARRAY_SIZE(_pwm_pattern_dim_blink))
+static nrf_pwm_values_common_t _pwm_dma_values[LED_PWM_DMA_SAMPLES];
+
+/**
+ * @brief Ping-pong buffers for streamed duty samples
+ *          Blocks form a ring (jitter buffer), the PWM plays two of them at a time
+ *          and the end of each sequence hands the next ready block to the PWM
+ * 
+ */
+static nrf_pwm_values_common_t _pwm_stream_blocks[LED_STREAM_NUM_BLOCKS][LED_STREAM_BLOCK_SAMPLES];
+static nrf_pwm_values_common_t _pwm_stream_hold[LED_STREAM_BLOCK_SAMPLES];   // Holds last duty on underrun
+static uint32_t _stream_arrival_cyc[LED_STREAM_NUM_BLOCKS];                 // Arrival time of first sample in block
+static const nrf_pwm_values_common_t * _stream_seq_values[2];              // Block currently assigned to each sequence
+static volatile uint32_t _stream_head;      // Next block written by the stream
+static volatile uint32_t _stream_tail;      // Next block handed to the PWM
+static size_t _stream_fill;                 // Samples written into head block
+static volatile bool _stream_enabled;
+static volatile bool _stream_playing;
+static led_stream_stats_t _stream_stats = { .latency_min_us = UINT32_MAX };
+
 /* GPIO */
 static nrfx_gpiote_t _gpiote = NRFX_GPIOTE_INSTANCE(LED_GPIOTE_INSTANCE);
 #define LED_EN_PIN DT_GPIO_PIN(DT_NODELABEL(user_gpio), led_en_gpios)
@@ -151,6 +185,158 @@ static nrfx_pwm_t _pwm_led = NRFX_PWM_INSTANCE(LED_PWM_INSTANCE);
 
 /* Other locals */
 led_pattern_t _current_pattern;
+K_MUTEX_DEFINE(_led_lock);
+
+/**
+ * @brief Record delay between a block's first sample arriving and its playback
+ * 
+ * @param block 
+ * @param now_cyc 
+ * @param start_delay_us time until the PWM starts playing the block
+ */
+static void led_stream_record_latency(uint32_t block, uint32_t now_cyc, uint32_t start_delay_us)
+{
+    uint32_t latency_us = k_cyc_to_us_floor32(now_cyc - _stream_arrival_cyc[block]) + start_delay_us;
+
+    _stream_stats.blocks_played++;
+    _stream_stats.latency_sum_us += latency_us;
+    if (latency_us < _stream_stats.latency_min_us)
+    {
+        _stream_stats.latency_min_us = latency_us;
+    }
+    if (latency_us > _stream_stats.latency_max_us)
+    {
+        _stream_stats.latency_max_us = latency_us;
+    }
+}
+
+/**
+ * @brief PWM event handler, refills the sequence that just ended
+ * 
+ * @param event_type 
+ * @param p_context 
+ */
+static void led_pwm_handler(nrfx_pwm_evt_type_t event_type, void * p_context)
+{
+    uint8_t seq_id;
+
+    if (!_stream_playing)
+    {
+        return;
+    }
+    if (event_type == NRFX_PWM_EVT_END_SEQ0)
+    {
+        seq_id = 0;
+    }
+    else if (event_type == NRFX_PWM_EVT_END_SEQ1)
+    {
+        seq_id = 1;
+    }
+    else
+    {
+        return;
+    }
+
+    /* The other sequence is now playing, so this one can be repointed */
+    const nrf_pwm_values_common_t * values;
+    if (_stream_head != _stream_tail)
+    {
+        uint32_t block = _stream_tail % LED_STREAM_NUM_BLOCKS;
+        values = _pwm_stream_blocks[block];
+        /* Block starts once the other sequence finishes */
+        led_stream_record_latency(block, k_cycle_get_32(), LED_STREAM_BLOCK_US);
+        _stream_tail++;
+    }
+    else
+    {
+        /* Underrun, hold the last duty until the stream catches up */
+        _stream_stats.underruns++;
+        if (_stream_seq_values[!seq_id] != _pwm_stream_hold)
+        {
+            for (size_t i = 0; i < LED_STREAM_BLOCK_SAMPLES; i++)
+            {
+                _pwm_stream_hold[i] = _stream_seq_values[!seq_id][LED_STREAM_BLOCK_SAMPLES - 1];
+            }
+        }
+        values = _pwm_stream_hold;
+    }
+    _stream_seq_values[seq_id] = values;
+    nrfx_pwm_sequence_values_update(&_pwm_led, seq_id, (nrf_pwm_values_t){ .p_common = values });
+}
+
+/**
+ * @brief Copy a stored pattern into RAM and loop it
+ * 
+ * @param seq 
+ */
+static void led_pwm_play(const nrf_pwm_sequence_t * seq)
+{
+    nrf_pwm_sequence_t ram_seq = *seq;
+
+    __ASSERT(seq->length <= LED_PWM_DMA_SAMPLES, "Pattern too long for DMA buffer");
+    memcpy(_pwm_dma_values, seq->values.p_common, seq->length * sizeof(nrf_pwm_values_common_t));
+    ram_seq.values.p_common = _pwm_dma_values;
+    nrfx_pwm_simple_playback(&_pwm_led, &ram_seq, 1, NRFX_PWM_FLAG_LOOP);
+}
+
+/**
+ * @brief Stop all LED outputs before switching pattern
+ * 
+ */
+static void led_outputs_disable(void)
+{
+    nrfx_err_t err;
+    /* Disable LED driver while setting up new pattern */
+    nrfx_gpiote_clr_task_trigger(&_gpiote, LED_EN_PIN);
+    /* Disable timer */
+    nrfx_timer_disable(&_timer_led);
+    nrfx_timer_clear(&_timer_led);
+    /* Disable PPI channels */
+    err = nrfx_ppi_channel_disable(_ppi_first_blink_start_ch);
+    NRFX_ASSERT(err == NRFX_SUCCESS);
+    err = nrfx_ppi_channel_disable(_ppi_first_blink_end_ch);
+    NRFX_ASSERT(err == NRFX_SUCCESS);
+    err = nrfx_ppi_channel_disable(_ppi_second_blink_start_ch);
+    NRFX_ASSERT(err == NRFX_SUCCESS);
+    err = nrfx_ppi_channel_disable(_ppi_second_blink_end_ch);
+    NRFX_ASSERT(err == NRFX_SUCCESS);
+    /* Disable PWM sequence */
+    _stream_playing = false;
+    nrfx_pwm_stop(&_pwm_led, true);
+}
+
+/**
+ * @brief Start playing the prefilled jitter buffer
+ * 
+ */
+static void led_stream_playback_start(void)
+{
+    uint32_t now_cyc = k_cycle_get_32();
+    uint32_t first = _stream_tail % LED_STREAM_NUM_BLOCKS;
+    uint32_t second = (_stream_tail + 1) % LED_STREAM_NUM_BLOCKS;
+    nrf_pwm_sequence_t seq0 =
+    {
+        .values = { _pwm_stream_blocks[first] },
+        .length = LED_STREAM_BLOCK_SAMPLES,
+        .repeats = LED_STREAM_SAMPLE_REPEATS,
+        .end_delay = 0
+    };
+    nrf_pwm_sequence_t seq1 = seq0;
+    seq1.values.p_common = _pwm_stream_blocks[second];
+
+    led_outputs_disable();
+    /* PWM owns the first two blocks from here on */
+    _stream_seq_values[0] = _pwm_stream_blocks[first];
+    _stream_seq_values[1] = _pwm_stream_blocks[second];
+    led_stream_record_latency(first, now_cyc, 0);
+    led_stream_record_latency(second, now_cyc, LED_STREAM_BLOCK_US);
+    _stream_tail += 2;
+    _stream_playing = true;
+    /* Enable LED driver constantly (stream will handle duty) */
+    nrfx_gpiote_set_task_trigger(&_gpiote, LED_EN_PIN);
+    nrfx_pwm_complex_playback(&_pwm_led, &seq0, &seq1, 1,
+        NRFX_PWM_FLAG_LOOP | NRFX_PWM_FLAG_SIGNAL_END_SEQ0 | NRFX_PWM_FLAG_SIGNAL_END_SEQ1);
+}
 
 void led_init(void)
 {
@@ -198,7 +384,7 @@ void led_init(void)
     /* PWM config */
     /* Initialize PWM */
     nrfx_pwm_config_t config = NRFX_PWM_DEFAULT_CONFIG(LED_PWM_PIN, NRF_PWM_PIN_NOT_CONNECTED, NRF_PWM_PIN_NOT_CONNECTED, NRF_PWM_PIN_NOT_CONNECTED);
-    err = nrfx_pwm_init(&_pwm_led, &config, NULL, &_pwm_led);
+    err = nrfx_pwm_init(&_pwm_led, &config, led_pwm_handler, &_pwm_led);
     NRFX_ASSERT(err == NRFX_SUCCESS);
     /* Handle PWM interrupt */
     IRQ_CONNECT(NRFX_IRQ_NUMBER_GET(NRF_PWM_INST_GET(LED_PWM_INSTANCE)), IRQ_PRIO_LOWEST, NRFX_PWM_INST_HANDLER_GET(LED_PWM_INSTANCE), 0, 0);
@@ -218,22 +404,11 @@ void led_init(void)
 void led_set_pattern(led_pattern_t pattern)
 {
     nrfx_err_t err;
-    /* Disable LED driver while setting up new pattern */
-    nrfx_gpiote_clr_task_trigger(&_gpiote, LED_EN_PIN);
-    /* Disable timer */
-    nrfx_timer_disable(&_timer_led);
-    nrfx_timer_clear(&_timer_led);
-    /* Disable PPI channels */
-    err = nrfx_ppi_channel_disable(_ppi_first_blink_start_ch);
-    NRFX_ASSERT(err == NRFX_SUCCESS);
-    err = nrfx_ppi_channel_disable(_ppi_first_blink_end_ch);
-    NRFX_ASSERT(err == NRFX_SUCCESS);
-    err = nrfx_ppi_channel_disable(_ppi_second_blink_start_ch);
-    NRFX_ASSERT(err == NRFX_SUCCESS);
-    err = nrfx_ppi_channel_disable(_ppi_second_blink_end_ch);
-    NRFX_ASSERT(err == NRFX_SUCCESS);
-    /* Disable PWM sequence */
-    nrfx_pwm_stop(&_pwm_led, true);
+
+    k_mutex_lock(&_led_lock, K_FOREVER);
+    /* A stored pattern always ends streaming */
+    _stream_enabled = false;
+    led_outputs_disable();
     /* Store new pattern */
     _current_pattern = pattern;
 
@@ -267,7 +442,7 @@ void led_set_pattern(led_pattern_t pattern)
             err = nrfx_ppi_channel_enable(_ppi_second_blink_end_ch);
             NRFX_ASSERT(err == NRFX_SUCCESS);
             /* Set PWM sequence to max brightness (will control blinks with enable GPIO) */
-            nrfx_pwm_simple_playback(&_pwm_led, &_pwm_seq_on, 1, NRFX_PWM_FLAG_LOOP);
+            led_pwm_play(&_pwm_seq_on);
             /* Start timer */
             nrfx_timer_enable(&_timer_led);
             break;
@@ -279,7 +454,7 @@ void led_set_pattern(led_pattern_t pattern)
             /* Enable LED driver constantly (PWM pattern will handle blinks) */
             nrfx_gpiote_set_task_trigger(&_gpiote, LED_EN_PIN);
             /* Set PWM sequence to dim blink pattern */
-            nrfx_pwm_simple_playback(&_pwm_led, &_pwm_seq_dim_blink, 1, NRFX_PWM_FLAG_LOOP);
+            led_pwm_play(&_pwm_seq_dim_blink);
             break;
         }
 
@@ -289,7 +464,7 @@ void led_set_pattern(led_pattern_t pattern)
             /* Enable LED driver constantly (PWM pattern will handle brightness) */
             nrfx_gpiote_set_task_trigger(&_gpiote, LED_EN_PIN);
             /* Set PWM sequence to bright solid pattern */
-            nrfx_pwm_simple_playback(&_pwm_led, &_pwm_seq_mid, 1, NRFX_PWM_FLAG_LOOP);
+            led_pwm_play(&_pwm_seq_mid);
             break;
         }
 
@@ -299,7 +474,7 @@ void led_set_pattern(led_pattern_t pattern)
             /* Enable LED driver constantly (PWM pattern will handle brightness) */
             nrfx_gpiote_set_task_trigger(&_gpiote, LED_EN_PIN);
             /* Set PWM sequence to dim solid pattern */
-            nrfx_pwm_simple_playback(&_pwm_led, &_pwm_seq_dim, 1, NRFX_PWM_FLAG_LOOP);
+            led_pwm_play(&_pwm_seq_dim);
             break;
         }
 
@@ -309,7 +484,7 @@ void led_set_pattern(led_pattern_t pattern)
             /* Enable LED driver constantly (PWM pattern will handle pulse) */
             nrfx_gpiote_set_task_trigger(&_gpiote, LED_EN_PIN);
             /* Set PWM sequence to pulse pattern */
-            nrfx_pwm_simple_playback(&_pwm_led, &_pwm_seq_pulse, 1, NRFX_PWM_FLAG_LOOP);
+            led_pwm_play(&_pwm_seq_pulse);
             break;
         }
 
@@ -330,10 +505,105 @@ void led_set_pattern(led_pattern_t pattern)
             break;
         }
     }
+    k_mutex_unlock(&_led_lock);
+    /* Keep pattern for a warm restart */
+    retained_set_pattern(pattern);
+    /* Broadcast new pattern */
+    beacon_update();
+}
+
+led_pattern_t led_get_pattern(void)
+{
+    return _current_pattern;
+}
+
+bool led_is_idle(void)
+{
+    return !nrfx_timer_is_enabled(&_timer_led) &&
+        !nrf_ppi_channel_enable_get(NRF_PPI, _ppi_first_blink_start_ch) &&
+        !nrf_ppi_channel_enable_get(NRF_PPI, _ppi_first_blink_end_ch) &&
+        !nrf_ppi_channel_enable_get(NRF_PPI, _ppi_second_blink_start_ch) &&
+        !nrf_ppi_channel_enable_get(NRF_PPI, _ppi_second_blink_end_ch) &&
+        nrfx_pwm_stopped_check(&_pwm_led);
 }
 
 void led_toggle_pattern(void)
 {
     _current_pattern = (_current_pattern + 1) % LED_PATTERN_NUM_PATTERNS;
     led_set_pattern(_current_pattern);
+}
+
+void led_stream_start(void)
+{
+    k_mutex_lock(&_led_lock, K_FOREVER);
+    if (!_stream_enabled)
+    {
+        /* Empty jitter buffer, stored pattern keeps playing until prefilled */
+        _stream_head = 0;
+        _stream_tail = 0;
+        _stream_fill = 0;
+        _stream_enabled = true;
+    }
+    k_mutex_unlock(&_led_lock);
+}
+
+void led_stream_write(const uint8_t * samples, size_t num_samples)
+{
+    k_mutex_lock(&_led_lock, K_FOREVER);
+    if (!_stream_enabled)
+    {
+        k_mutex_unlock(&_led_lock);
+        return;
+    }
+
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        /* The PWM owns the two blocks behind the tail while playing */
+        uint32_t capacity = _stream_playing ? (LED_STREAM_NUM_BLOCKS - 2) : LED_STREAM_NUM_BLOCKS;
+        if ((_stream_head - _stream_tail) >= capacity)
+        {
+            _stream_stats.overruns += num_samples - i;
+            break;
+        }
+
+        uint32_t block = _stream_head % LED_STREAM_NUM_BLOCKS;
+        if (_stream_fill == 0)
+        {
+            _stream_arrival_cyc[block] = k_cycle_get_32();
+        }
+        /* Write sample straight into the DMA buffer (bit 15 is PWM polarity, keep clear) */
+        _pwm_stream_blocks[block][_stream_fill++] = sys_get_le16(&samples[i * 2]) & 0x7FFF;
+        if (_stream_fill == LED_STREAM_BLOCK_SAMPLES)
+        {
+            /* Publish block to the PWM handler once all samples are in memory */
+            _stream_fill = 0;
+            barrier_dmem_fence_full();
+            _stream_head++;
+        }
+    }
+
+    if (!_stream_playing && ((_stream_head - _stream_tail) >= LED_STREAM_PREFILL_BLOCKS))
+    {
+        led_stream_playback_start();
+    }
+    k_mutex_unlock(&_led_lock);
+}
+
+void led_stream_stop(void)
+{
+    k_mutex_lock(&_led_lock, K_FOREVER);
+    if (_stream_playing)
+    {
+        /* Fall back to the last stored pattern */
+        led_set_pattern(_current_pattern);
+    }
+    _stream_enabled = false;
+    k_mutex_unlock(&_led_lock);
+}
+
+void led_stream_get_stats(led_stream_stats_t * stats)
+{
+    unsigned int key = irq_lock();
+    *stats = _stream_stats;
+    irq_unlock(key);
 }
\ No newline at end of file
@@ -12,9 +12,22 @@
 #ifndef __LED_H__
 #define __LED_H__
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #define LED_GPIOTE_INSTANCE 0
 #define LED_PWM_INSTANCE    1
-#define LED_TIMER_INSTANCE  0
+#define LED_TIMER_INSTANCE  2   // TIMER0 is reserved by the BLE controller
+
+/* Streaming duty mode
+    Each sample is held for (LED_STREAM_SAMPLE_REPEATS + 1) PWM periods of 1ms */
+#define LED_STREAM_SAMPLE_REPEATS   4
+#define LED_STREAM_SAMPLE_US        ((LED_STREAM_SAMPLE_REPEATS + 1) * 1000)
+#define LED_STREAM_BLOCK_SAMPLES    8
+#define LED_STREAM_BLOCK_US         (LED_STREAM_BLOCK_SAMPLES * LED_STREAM_SAMPLE_US)
+#define LED_STREAM_NUM_BLOCKS       6
+#define LED_STREAM_PREFILL_BLOCKS   3   // Blocks buffered before playback starts (jitter buffer depth)
 
 typedef enum
 {
@@ -28,6 +41,17 @@ typedef enum
 }
 led_pattern_t;
 
+typedef struct
+{
+    uint32_t blocks_played;     // Stream blocks handed to the PWM
+    uint32_t underruns;         // PWM sequence ends with no block ready
+    uint32_t overruns;          // Samples dropped because the jitter buffer was full
+    uint32_t latency_min_us;    // Sample arrival to start of playback
+    uint32_t latency_max_us;
+    uint64_t latency_sum_us;
+}
+led_stream_stats_t;
+
 #endif  /* __LED_H__ */
 
 /**
@@ -43,8 +67,52 @@ void led_init(void);
  */
 void led_set_pattern(led_pattern_t pattern);
 
+/**
+ * @brief Get the stored blink pattern
+ * 
+ * @return led_pattern_t 
+ */
+led_pattern_t led_get_pattern(void);
+
+/**
+ * @brief Check that the timer, PPI channels and PWM are all stopped
+ *          Should be true whenever the pattern is LED_PATTERN_OFF
+ * 
+ * @return true if no LED hardware is running
+ */
+bool led_is_idle(void);
+
 /**
  * @brief Toggle blink pattern (cycle through all patterns)
  * 
  */
-void led_toggle_pattern(void);
\ No newline at end of file
+void led_toggle_pattern(void);
+
+/**
+ * @brief Prepare the LED for streaming duty samples
+ *          The stored pattern keeps playing until the jitter buffer is prefilled
+ * 
+ */
+void led_stream_start(void);
+
+/**
+ * @brief Write streamed duty samples directly into the PWM sequence buffers
+ *          Samples use the same units as the stored patterns (PWM compare value, 0 - 1000)
+ * 
+ * @param samples little-endian 16-bit samples
+ * @param num_samples 
+ */
+void led_stream_write(const uint8_t * samples, size_t num_samples);
+
+/**
+ * @brief Stop streaming and fall back to the last stored pattern
+ * 
+ */
+void led_stream_stop(void);
+
+/**
+ * @brief Get streaming statistics
+ * 
+ * @param stats 
+ */
+void led_stream_get_stats(led_stream_stats_t * stats);
\ No newline at end of file
@@ -9,19 +9,23 @@
  * 
  */
 
+#include "beacon.h"
+#include "ble.h"
 #include "button.h"
 #include "device.h"
 #include "led.h"
+#include "soak.h"
+#include "stream.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <nrfx_gpiote.h>
 
-LOG_MODULE_REGISTER(MAIN, LOG_LEVEL_DBG);
+LOG_MODULE_REGISTER(MAIN, CONFIG_APP_LOG_LEVEL);
 
 /* Define task to handle button events */
 #define BUTTON_THREAD_PRIORITY  4
-K_THREAD_DEFINE(button_task_id, 1024, button_thread, NULL, NULL, NULL, BUTTON_THREAD_PRIORITY, 0, K_TICKS_FOREVER);  // Delay start to allow GPIO time to initialize
+K_THREAD_DEFINE(button_task_id, CONFIG_APP_BUTTON_STACK_SIZE, button_thread, NULL, NULL, NULL, BUTTON_THREAD_PRIORITY, 0, K_TICKS_FOREVER);  // Delay start to allow GPIO time to initialize
 
 /**
  * @brief Application entry point
@@ -38,14 +42,34 @@ int main(void)
 
     /* Initialize drivers */
     led_init();
+    /* Bring the light back before anything slower after a watchdog, lockup or soft reset */
+    bool warm_restart = device_warm_restart(reset_src);
+#if !defined(CONFIG_APP_SOAK)
+    /* Radio stays off in soak builds so it can't preempt the timed calls */
+    ble_init();
+    stream_init();
+    beacon_init();
+#endif
+    device_wdt_init();
     button_init();  // Needs to be last to enable all other wakeup sources before sleeping
 
+#if defined(CONFIG_APP_SOAK)
+    /* Benchmark replaces the button thread */
+    soak_run();
+#endif
+
     /* Start threads */
     k_thread_start(button_task_id);
 
-    /* Put device to sleep if reset from flashing */
-    if (reset_src == DEVICE_RESET_SRC_RESET_PIN)
+    if (warm_restart)
+    {
+        /* Finish waking up now that Bluetooth is ready */
+        ble_adv_start();
+        beacon_start();
+    }
+    else if (reset_src == DEVICE_RESET_SRC_RESET_PIN)
     {
+        /* Put device to sleep if reset from flashing */
         device_poweroff();
     }
 
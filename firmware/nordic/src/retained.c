@@ -0,0 +1,142 @@
+/**
+ * @file retained.c
+ * @author agent (agent@local)
+ * @brief File containing state kept in RAM across watchdog, lockup and soft resets
+ *          RAM isn't retained in System OFF, so a GPIO wakeup always starts clean
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include "retained.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/crc.h>
+
+#include <stddef.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(RETAINED, CONFIG_APP_LOG_LEVEL);
+
+#define RETAINED_MAGIC  0x42424C31  // "BBL1"
+
+/**
+ * LOCAL VARIABLES
+ */
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t state;         // device_state_t
+    uint32_t pattern;       // led_pattern_t
+    retained_crash_t crash;
+    uint32_t warm_restarts; // Consecutive warm restarts without a clean run
+    uint32_t crc;           // Must be last
+}
+retained_block_t;
+
+/* Not cleared by the C runtime at boot */
+static __noinit retained_block_t _retained;
+
+/**
+ * FUNCTION DEFINITIONS
+ */
+
+static uint32_t retained_crc(void)
+{
+    return crc32_ieee((const uint8_t *)&_retained, offsetof(retained_block_t, crc));
+}
+
+/**
+ * @brief Update checksum after changing the block
+ *          Callers lock interrupts so a fault or watchdog can't see a half written block
+ * 
+ */
+static void retained_commit(void)
+{
+    _retained.crc = retained_crc();
+}
+
+bool retained_init(void)
+{
+    if ((_retained.magic == RETAINED_MAGIC) && (_retained.crc == retained_crc()))
+    {
+        return true;
+    }
+
+    /* Cold boot or corrupted, start from scratch */
+    memset(&_retained, 0, sizeof(_retained));
+    _retained.magic = RETAINED_MAGIC;
+    _retained.state = DEVICE_STATE_POWEROFF;
+    _retained.pattern = LED_PATTERN_OFF;
+    retained_commit();
+    return false;
+}
+
+void retained_get_state(device_state_t * state, led_pattern_t * pattern)
+{
+    *state = _retained.state;
+    *pattern = _retained.pattern;
+}
+
+void retained_set_state(device_state_t state)
+{
+    unsigned int key = irq_lock();
+    _retained.state = state;
+    retained_commit();
+    irq_unlock(key);
+}
+
+void retained_set_pattern(led_pattern_t pattern)
+{
+    unsigned int key = irq_lock();
+    _retained.pattern = pattern;
+    retained_commit();
+    irq_unlock(key);
+}
+
+void retained_save_crash(retained_fault_t fault, uint32_t reason, uint32_t pc, uint32_t lr)
+{
+    unsigned int key = irq_lock();
+    _retained.crash.count++;
+    _retained.crash.fault = fault;
+    _retained.crash.reason = reason;
+    _retained.crash.pc = pc;
+    _retained.crash.lr = lr;
+    _retained.crash.reported = 0;
+    retained_commit();
+    irq_unlock(key);
+}
+
+void retained_set_crash_reported(void)
+{
+    unsigned int key = irq_lock();
+    _retained.crash.reported = 1;
+    retained_commit();
+    irq_unlock(key);
+}
+
+uint32_t retained_add_warm_restart(void)
+{
+    unsigned int key = irq_lock();
+    uint32_t count = ++_retained.warm_restarts;
+    retained_commit();
+    irq_unlock(key);
+    return count;
+}
+
+void retained_clear_warm_restarts(void)
+{
+    unsigned int key = irq_lock();
+    _retained.warm_restarts = 0;
+    retained_commit();
+    irq_unlock(key);
+}
+
+void retained_get_crash(retained_crash_t * crash)
+{
+    *crash = _retained.crash;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file retained.h
+ * @author agent (agent@local)
+ * @brief Header file for retained.c
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#ifndef __RETAINED_H__
+#define __RETAINED_H__
+
+#include "device.h"
+#include "led.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ENUMERATION DEFINITIONS */
+
+typedef enum
+{
+    RETAINED_FAULT_NONE,
+    RETAINED_FAULT_FATAL_ERROR,     // Kernel fatal error (CPU exception, assert, stack overflow)
+    RETAINED_FAULT_WATCHDOG,        // Watchdog timed out
+}
+retained_fault_t;
+
+/* STRUCTURE DEFINITIONS */
+
+typedef struct
+{
+    uint32_t count;         // Faults recorded since power on
+    uint32_t fault;         // retained_fault_t of the last fault
+    uint32_t reason;        // Kernel fatal error reason (K_ERR_*)
+    uint32_t pc;
+    uint32_t lr;
+    uint32_t reported;      // Set once the record has been logged, cleared by a new fault
+}
+retained_crash_t;
+
+/**
+ * FUNCTION DECLARATIONS
+ */
+
+/**
+ * @brief Validate the retained block, reset it if the checksum doesn't match
+ *          Needs to be called before any other retained function
+ * 
+ * @return true if contents survived the last reset
+ */
+bool retained_init(void);
+
+/**
+ * @brief Get device state and LED pattern from before the last reset
+ * 
+ * @param state 
+ * @param pattern 
+ */
+void retained_get_state(device_state_t * state, led_pattern_t * pattern);
+
+/**
+ * @brief Store device state for a warm restart
+ * 
+ * @param state 
+ */
+void retained_set_state(device_state_t state);
+
+/**
+ * @brief Store LED pattern for a warm restart
+ * 
+ * @param pattern 
+ */
+void retained_set_pattern(led_pattern_t pattern);
+
+/**
+ * @brief Record a fault, safe to call from fault and interrupt context
+ * 
+ * @param fault 
+ * @param reason 
+ * @param pc 
+ * @param lr 
+ */
+void retained_save_crash(retained_fault_t fault, uint32_t reason, uint32_t pc, uint32_t lr);
+
+/**
+ * @brief Mark the last crash record as reported so it isn't blamed for a later reset
+ * 
+ */
+void retained_set_crash_reported(void);
+
+/**
+ * @brief Count a warm restart
+ * 
+ * @return uint32_t consecutive warm restarts including this one
+ */
+uint32_t retained_add_warm_restart(void);
+
+/**
+ * @brief Clear the consecutive warm restart count after a clean run
+ * 
+ */
+void retained_clear_warm_restarts(void);
+
+/**
+ * @brief Get the last crash record
+ * 
+ * @param crash 
+ */
+void retained_get_crash(retained_crash_t * crash);
+
+#endif  /* __RETAINED_H__ */
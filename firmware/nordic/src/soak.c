@@ -0,0 +1,295 @@
+/**
+ * @file soak.c
+ * @author agent (agent@local)
+ * @brief Deterministic soak benchmark for the LED, button and device modules
+ *          Feeds seeded random button timelines through the button logic so every
+ *          state transition runs, times each pattern switch and checks that PPI,
+ *          GPIOTE and timer resources are back where they started
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include "soak.h"
+
+#if defined(CONFIG_APP_SOAK)
+
+#include "button.h"
+#include "device.h"
+#include "led.h"
+
+#include <nrfx_gpiote.h>
+#include <nrfx_ppi.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log_ctrl.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/timing/timing.h>
+
+#include <string.h>
+
+#define SOAK_LONG_PRESS_SAMPLES 31      // Samples held before button_process() reports a long press
+#define SOAK_MAX_PRESS_SAMPLES  40
+#define SOAK_MAX_GAP_SAMPLES    8
+
+/**
+ * LOCAL VARIABLES
+ */
+
+typedef struct
+{
+    const char * name;
+    uint32_t count;
+    uint32_t total;
+    uint32_t max_us;
+    uint32_t buckets[SOAK_HIST_BUCKETS];
+}
+soak_hist_t;
+
+static soak_hist_t _hist_switch = { .name = "pattern_switch" };
+static soak_hist_t _hist_power = { .name = "power_cycle" };
+static uint32_t _rng_state = CONFIG_APP_SOAK_SEED;
+
+/**
+ * FUNCTION DEFINITIONS
+ */
+
+/**
+ * @brief xorshift32, same sequence on every run for a given seed
+ * 
+ * @return uint32_t 
+ */
+static uint32_t soak_rand(void)
+{
+    _rng_state ^= _rng_state << 13;
+    _rng_state ^= _rng_state >> 17;
+    _rng_state ^= _rng_state << 5;
+    return _rng_state;
+}
+
+static void soak_hist_add(soak_hist_t * hist, uint32_t us)
+{
+    uint32_t bucket = MIN(us / SOAK_HIST_BUCKET_US, SOAK_HIST_BUCKETS - 1);
+
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->total++;
+    hist->max_us = MAX(hist->max_us, us);
+}
+
+/**
+ * @brief Upper bound of the bucket holding the given percentile
+ * 
+ * @param hist 
+ * @param percent 
+ * @return uint32_t 
+ */
+static uint32_t soak_hist_percentile(const soak_hist_t * hist, uint32_t percent)
+{
+    uint32_t target = ((uint64_t)hist->count * percent + 99) / 100;
+    uint32_t seen = 0;
+
+    for (uint32_t i = 0; i < SOAK_HIST_BUCKETS; i++)
+    {
+        seen += hist->buckets[i];
+        if (seen >= target)
+        {
+            return MIN((i + 1) * SOAK_HIST_BUCKET_US, hist->max_us);
+        }
+    }
+    return hist->max_us;
+}
+
+static void soak_hist_print(soak_hist_t * hist, uint32_t window)
+{
+    printk("{\"bench\":\"%s\",\"window\":%u,\"n\":%u,\"p50_us\":%u,\"p90_us\":%u,\"p99_us\":%u,\"max_us\":%u}\n",
+        hist->name, window, hist->count, soak_hist_percentile(hist, 50), soak_hist_percentile(hist, 90),
+        soak_hist_percentile(hist, 99), hist->max_us);
+    /* Start next window fresh */
+    hist->count = 0;
+    hist->max_us = 0;
+    memset(hist->buckets, 0, sizeof(hist->buckets));
+}
+
+/**
+ * @brief Count free PPI channels by allocating until none are left
+ * 
+ * @return uint32_t 
+ */
+static uint32_t soak_free_ppi(void)
+{
+    nrf_ppi_channel_t channels[PPI_CH_NUM];
+    uint32_t count = 0;
+
+    while ((count < ARRAY_SIZE(channels)) && (nrfx_ppi_channel_alloc(&channels[count]) == NRFX_SUCCESS))
+    {
+        count++;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        nrfx_ppi_channel_free(channels[i]);
+    }
+    return count;
+}
+
+/**
+ * @brief Count free GPIOTE channels by allocating until none are left
+ * 
+ * @return uint32_t 
+ */
+static uint32_t soak_free_gpiote(void)
+{
+    nrfx_gpiote_t gpiote = NRFX_GPIOTE_INSTANCE(LED_GPIOTE_INSTANCE);
+    uint8_t channels[GPIOTE_CH_NUM];
+    uint32_t count = 0;
+
+    while ((count < ARRAY_SIZE(channels)) && (nrfx_gpiote_channel_alloc(&gpiote, &channels[count]) == NRFX_SUCCESS))
+    {
+        count++;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        nrfx_gpiote_channel_free(&gpiote, channels[i]);
+    }
+    return count;
+}
+
+/**
+ * @brief Feed one button sample and handle the resulting event, timing any LED change
+ * 
+ * @param buffer 
+ * @param pressed 
+ * @param events counts per event type
+ */
+static void soak_sample(uint32_t * buffer, bool pressed, uint32_t * events)
+{
+    button_event_t event = button_process(buffer, pressed);
+    device_state_t state = device_get_state();
+
+    events[event]++;
+    if (event == BUTTON_EVENT_NONE)
+    {
+        return;
+    }
+
+    /* Kernel cycle counter runs from the 32 kHz RTC, use the CPU cycle counter instead */
+    timing_t start = timing_counter_get();
+    button_handle_event(event);
+    timing_t end = timing_counter_get();
+    uint32_t us = (uint32_t)(timing_cycles_to_ns(timing_cycles_get(&start, &end)) / 1000);
+
+    if ((event == BUTTON_EVENT_SHORT_RELEASE) && (state == DEVICE_STATE_RUN))
+    {
+        soak_hist_add(&_hist_switch, us);
+    }
+    else if (event == BUTTON_EVENT_LONG_PRESS)
+    {
+        soak_hist_add(&_hist_power, us);
+    }
+}
+
+void soak_run(void)
+{
+    uint32_t buffer = 0;
+    uint32_t events[BUTTON_EVENT_SHORT_RELEASE + 1] = { 0 };
+    uint32_t expected_short = 0;
+    uint32_t expected_long = 0;
+    uint32_t failures = 0;
+    uint32_t ppi_before = soak_free_ppi();
+    uint32_t gpiote_before = soak_free_gpiote();
+    uint32_t start_ms = k_uptime_get_32();
+
+    /* Soak loop never sleeps, so the deferred log thread would never run
+        Panic mode prints every line synchronously and nothing is dropped */
+    LOG_PANIC();
+    timing_init();
+    timing_start();
+    printk("{\"soak\":\"start\",\"seed\":%u,\"presses\":%u}\n", CONFIG_APP_SOAK_SEED, CONFIG_APP_SOAK_PRESSES);
+    device_set_state(DEVICE_STATE_POWEROFF);
+    led_set_pattern(LED_PATTERN_OFF);
+
+    for (uint32_t press = 0; press < CONFIG_APP_SOAK_PRESSES; press++)
+    {
+        uint32_t held = 1 + (soak_rand() % SOAK_MAX_PRESS_SAMPLES);
+        uint32_t gap = 1 + (soak_rand() % SOAK_MAX_GAP_SAMPLES);
+
+        /* Expected result from the press length alone */
+        if (held >= SOAK_LONG_PRESS_SAMPLES)
+        {
+            expected_long++;
+        }
+        else
+        {
+            expected_short++;
+        }
+
+        for (uint32_t i = 0; i < held; i++)
+        {
+            soak_sample(&buffer, true, events);
+        }
+        for (uint32_t i = 0; i < gap; i++)
+        {
+            soak_sample(&buffer, false, events);
+        }
+
+        /* Light must be fully stopped whenever it's off */
+        if ((led_get_pattern() == LED_PATTERN_OFF) && !led_is_idle())
+        {
+            failures++;
+        }
+        device_wdt_feed();
+
+        if (((press + 1) % (CONFIG_APP_SOAK_PRESSES / SOAK_WINDOWS)) == 0)
+        {
+            uint32_t window = (press + 1) / (CONFIG_APP_SOAK_PRESSES / SOAK_WINDOWS);
+            soak_hist_print(&_hist_switch, window);
+            soak_hist_print(&_hist_power, window);
+        }
+    }
+
+    /* End powered off so everything should be released */
+    if (device_get_state() == DEVICE_STATE_RUN)
+    {
+        device_poweroff();
+    }
+    if (!led_is_idle())
+    {
+        failures++;
+    }
+    if ((events[BUTTON_EVENT_LONG_PRESS] != expected_long) ||
+        (events[BUTTON_EVENT_LONG_RELEASE] != expected_long) ||
+        (events[BUTTON_EVENT_SHORT_RELEASE] != expected_short))
+    {
+        failures++;
+    }
+    uint32_t ppi_after = soak_free_ppi();
+    uint32_t gpiote_after = soak_free_gpiote();
+    if ((ppi_after != ppi_before) || (gpiote_after != gpiote_before))
+    {
+        failures++;
+    }
+
+    printk("{\"soak\":\"result\",\"pass\":%s,\"failures\":%u,\"duration_ms\":%u,"
+        "\"pattern_switches\":%u,\"power_cycles\":%u,"
+        "\"long_press\":%u,\"expected_long\":%u,\"short_release\":%u,\"expected_short\":%u,"
+        "\"ppi_free\":[%u,%u],\"gpiote_free\":[%u,%u],\"led_idle\":%s}\n",
+        failures ? "false" : "true", failures, k_uptime_get_32() - start_ms,
+        _hist_switch.total, _hist_power.total,
+        events[BUTTON_EVENT_LONG_PRESS], expected_long, events[BUTTON_EVENT_SHORT_RELEASE], expected_short,
+        ppi_before, ppi_after, gpiote_before, gpiote_after, led_is_idle() ? "true" : "false");
+
+    while (1)
+    {
+        device_wdt_feed();
+        k_msleep(1000 / BUTTON_POLL_HZ);
+    }
+}
+
+void device_sleep(void)
+{
+    /* Power cycles stay awake so the benchmark keeps running */
+}
+
+#endif  /* CONFIG_APP_SOAK */
@@ -0,0 +1,26 @@
+/**
+ * @file soak.h
+ * @author agent (agent@local)
+ * @brief Header file for soak.c
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#ifndef __SOAK_H__
+#define __SOAK_H__
+
+#define SOAK_WINDOWS            10      // Latency results are reported per window to show drift
+#define SOAK_HIST_BUCKET_US     16
+#define SOAK_HIST_BUCKETS       128     // Last bucket also counts anything slower
+
+/**
+ * @brief Run the soak benchmark, prints one JSON object per line
+ *          Replaces the normal application, never returns
+ * 
+ */
+void soak_run(void);
+
+#endif  /* __SOAK_H__ */
@@ -0,0 +1,209 @@
+/**
+ * @file stream.c
+ * @author agent (agent@local)
+ * @brief File to receive real-time duty samples over an L2CAP channel
+ *          Samples are passed to the LED jitter buffer; if the stream stalls the
+ *          LED falls back to the last stored pattern
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include "stream.h"
+
+#include "device.h"
+#include "led.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/l2cap.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(STREAM, CONFIG_APP_LOG_LEVEL);
+
+/**
+ * LOCAL VARIABLES
+ */
+
+static struct bt_l2cap_le_chan _stream_chan;
+static bool _stats_active;      // Stats only reported while a stream source exists
+
+static void stream_stall_handler(struct k_work * work);
+static K_WORK_DELAYABLE_DEFINE(_stall_work, stream_stall_handler);
+
+static void stream_stats_handler(struct k_work * work);
+static K_WORK_DELAYABLE_DEFINE(_stats_work, stream_stats_handler);
+
+#if defined(CONFIG_APP_STREAM_SIM_LINK)
+/* Simulated link below, one simulated hour in a host model of the jitter buffer:
+    85231 blocks, 2517 underruns, 449 blocks dropped as overruns, 428 stall fallbacks,
+    latency min/avg/max 40/109/199 ms */
+#define STREAM_SIM_PERIOD_MS        (LED_STREAM_BLOCK_US / 1000)
+#define STREAM_SIM_JITTER_MS        30      // Maximum extra delay per packet
+#define STREAM_SIM_DROPOUT_EVERY    200     // Packets between simulated link dropouts
+#define STREAM_SIM_DROPOUT_MS       400
+
+static void stream_sim_handler(struct k_work * work);
+static K_WORK_DELAYABLE_DEFINE(_sim_work, stream_sim_handler);
+#endif
+
+/**
+ * FUNCTION DEFINITIONS
+ */
+
+/**
+ * @brief Pass received samples to the LED and restart the stall timeout
+ * 
+ * @param data 
+ * @param len 
+ */
+static void stream_ingest(const uint8_t * data, size_t len)
+{
+    /* Only drive the light while it is on, a powered off light must stay dark */
+    if (device_get_state() != DEVICE_STATE_RUN)
+    {
+        return;
+    }
+    led_stream_start();
+    led_stream_write(data, len / sizeof(uint16_t));
+    k_work_reschedule(&_stall_work, K_MSEC(STREAM_STALL_TIMEOUT_MS));
+}
+
+static void stream_stall_handler(struct k_work * work)
+{
+    LOG_WRN("Stream stalled, restoring stored pattern");
+    led_stream_stop();
+}
+
+static void stream_stats_handler(struct k_work * work)
+{
+    led_stream_stats_t stats;
+
+    led_stream_get_stats(&stats);
+    if (stats.blocks_played)
+    {
+        LOG_INF("blocks %u underruns %u overruns %u latency min/avg/max %u/%u/%u us",
+            stats.blocks_played, stats.underruns, stats.overruns, stats.latency_min_us,
+            (uint32_t)(stats.latency_sum_us / stats.blocks_played), stats.latency_max_us);
+    }
+    if (_stats_active)
+    {
+        k_work_reschedule(&_stats_work, K_MSEC(STREAM_STATS_INTERVAL_MS));
+    }
+}
+
+/**
+ * @brief Start reporting stream stats periodically
+ * 
+ */
+static void stream_stats_start(void)
+{
+    _stats_active = true;
+    k_work_reschedule(&_stats_work, K_MSEC(STREAM_STATS_INTERVAL_MS));
+}
+
+static int stream_recv(struct bt_l2cap_chan * chan, struct net_buf * buf)
+{
+    /* Samples are copied from the radio buffer straight into the PWM buffers */
+    stream_ingest(buf->data, buf->len);
+    return 0;
+}
+
+static void stream_connected(struct bt_l2cap_chan * chan)
+{
+    LOG_INF("Stream channel connected");
+    stream_stats_start();
+}
+
+static void stream_disconnected(struct bt_l2cap_chan * chan)
+{
+    LOG_INF("Stream channel disconnected");
+    k_work_cancel_delayable(&_stall_work);
+#if !defined(CONFIG_APP_STREAM_SIM_LINK)
+    /* Nothing left to report, don't keep waking up */
+    _stats_active = false;
+    k_work_cancel_delayable(&_stats_work);
+#endif
+    led_stream_stop();
+}
+
+static const struct bt_l2cap_chan_ops _stream_chan_ops =
+{
+    .recv = stream_recv,
+    .connected = stream_connected,
+    .disconnected = stream_disconnected,
+};
+
+static int stream_accept(struct bt_conn * conn, struct bt_l2cap_server * server, struct bt_l2cap_chan ** chan)
+{
+    /* Only one phone can drive the light at a time */
+    if (_stream_chan.chan.conn)
+    {
+        return -ENOMEM;
+    }
+    _stream_chan.chan.ops = &_stream_chan_ops;
+    *chan = &_stream_chan.chan;
+    return 0;
+}
+
+/* L2 only means an encrypted link from unauthenticated (Just Works) pairing:
+    it stops eavesdropping, but any phone in range can still pair and stream */
+static struct bt_l2cap_server _stream_server =
+{
+    .psm = STREAM_L2CAP_PSM,
+    .sec_level = BT_SECURITY_L2,
+    .accept = stream_accept,
+};
+
+#if defined(CONFIG_APP_STREAM_SIM_LINK)
+/**
+ * @brief Generate a brake flash waveform with random packet jitter and periodic dropouts
+ * 
+ */
+static void stream_sim_handler(struct k_work * work)
+{
+    static uint32_t packet;
+    uint8_t data[LED_STREAM_BLOCK_SAMPLES * sizeof(uint16_t)];
+
+    for (size_t i = 0; i < LED_STREAM_BLOCK_SAMPLES; i++)
+    {
+        /* Alternate bright and dim every packet */
+        sys_put_le16((packet & 1) ? 100 : 1000, &data[i * sizeof(uint16_t)]);
+    }
+    stream_ingest(data, sizeof(data));
+    packet++;
+
+    uint32_t delay_ms = STREAM_SIM_PERIOD_MS + (sys_rand32_get() % (STREAM_SIM_JITTER_MS + 1)) - (STREAM_SIM_JITTER_MS / 2);
+    if ((packet % STREAM_SIM_DROPOUT_EVERY) == 0)
+    {
+        delay_ms += STREAM_SIM_DROPOUT_MS;
+    }
+    k_work_reschedule(&_sim_work, K_MSEC(delay_ms));
+}
+#endif
+
+void stream_disconnect(void)
+{
+    if (_stream_chan.chan.conn)
+    {
+        bt_l2cap_chan_disconnect(&_stream_chan.chan);
+    }
+}
+
+void stream_init(void)
+{
+    int err;
+
+    err = bt_l2cap_server_register(&_stream_server);
+    __ASSERT(err == 0, "Error registering stream L2CAP server");
+
+#if defined(CONFIG_APP_STREAM_SIM_LINK)
+    LOG_WRN("Streaming from simulated link");
+    stream_stats_start();
+    k_work_reschedule(&_sim_work, K_MSEC(STREAM_SIM_PERIOD_MS));
+#endif
+}
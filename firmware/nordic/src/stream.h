@@ -0,0 +1,32 @@
+/**
+ * @file stream.h
+ * @author agent (agent@local)
+ * @brief Header file for stream.c
+ * 
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#define STREAM_L2CAP_PSM            0x0080  // First dynamic LE PSM
+#define STREAM_STALL_TIMEOUT_MS     250     // Fall back to stored pattern after this long without samples
+#define STREAM_STATS_INTERVAL_MS    5000
+
+/**
+ * @brief Register the L2CAP channel that receives duty samples
+ *          Each SDU carries little-endian 16-bit PWM compare values
+ * 
+ */
+void stream_init(void);
+
+/**
+ * @brief Close the stream channel if a phone has it open
+ * 
+ */
+void stream_disconnect(void);
+
+#endif  /* __STREAM_H__ */